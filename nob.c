@@ -3,33 +3,185 @@
 #define NOB_IMPLEMENTATION
 #include "nob.h"
 
+#define IJ_LOG_INFO(...)
+#define IJ_LOG_ERROR(...)
+#include "ij.h"
+
 bool is_letter(char c){
   return (c >= 'a' && c <= 'z') 
     || (c >= 'A' && c <= 'Z')
     || c == '_';
 }
 
-bool compile_tests(void){
+bool is_space(char c){
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+// steps over a comment, string or character literal starting at s, so
+// the scanners below only see code. returns s for anything else
+char* skip_non_code(char* s, char* end){
+  if(s+1 < end && s[0] == '/' && s[1] == '/'){
+    while(s < end && *s != '\n') s++;
+    return s;
+  }
+  if(s+1 < end && s[0] == '/' && s[1] == '*'){
+    s += 2;
+    while(s+1 < end && !(s[0] == '*' && s[1] == '/')) s++;
+    return s+2 < end ? s+2 : end;
+  }
+  if(*s == '"' || *s == '\''){
+    char quote = *s++;
+    while(s < end && *s != quote){
+      if(*s == '\\') s++;
+      s++;
+    }
+    return s < end ? s+1 : end;
+  }
+  return s;
+}
+
+typedef struct{
+  const char** items;
+  size_t count;
+  size_t capacity;
+} Names;
+
+// finds a seed for which ij_hash maps every name to its own slot
+bool find_perfect_hash(Names names, uint32_t* seed, uint32_t* slots){
+  uint32_t size = 1;
+  while(size < names.count) size <<= 1;
+
+  bool used[1024];
+  for(; size <= 1024; size <<= 1){
+    for(uint32_t s = 0; s < 100000; ++s){
+      memset(used, 0, sizeof(used));
+      bool collision = false;
+      for(size_t i = 0; i < names.count && !collision; ++i){
+        uint32_t slot = ij_hash(names.items[i], strlen(names.items[i]), s) & (size-1);
+        collision = used[slot];
+        used[slot] = true;
+      }
+      if(!collision){
+        *seed = s;
+        *slots = size;
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// IJ_MEMBER_SET(name, "a", "b", ...) in a source file becomes
+// name_member_lookup(), a perfect hash over the names that confirms the
+// match with a length check and a memcmp
+bool generate_member_sets(const char* path, Nob_String_Builder* out){
   Nob_String_Builder in = {0};
-  if(!nob_read_entire_file("test.c", &in)) return false;
+  if(!nob_read_entire_file(path, &in)) return false;
 
   char* end = in.items + in.count;
   char* s = in.items;
+  const char* pattern = "IJ_MEMBER_SET(";
+
+  while(s < end){
+    char* code = skip_non_code(s, end);
+    if(code != s){
+      s = code;
+      continue;
+    }
+    if(strncmp(s, pattern, strlen(pattern)) != 0){
+      s++;
+      continue;
+    }
+    s += strlen(pattern);
+
+    while(s < end && is_space(*s)) s++;
+    char* name = s;
+    while(s < end && (is_letter(*s) || (*s >= '0' && *s <= '9'))) s++;
+    int name_len = s-name;
+
+    Names names = {0};
+    while(s < end && *s != ')'){
+      if(*s == '"'){
+        char* str = ++s;
+        while(s < end && *s != '"') s++;
+        nob_da_append(&names, nob_temp_sprintf("%.*s", (int)(s-str), str));
+      }
+      s++;
+    }
+
+    uint32_t seed = 0;
+    uint32_t size = 0;
+    if(!find_perfect_hash(names, &seed, &size)){
+      nob_log(NOB_ERROR, "%s: no perfect hash found for member set %.*s",
+          path, name_len, name);
+      return false;
+    }
+
+    nob_sb_appendf(out, "int %.*s_member_lookup(const char* key, int len){\n", name_len, name);
+    nob_sb_appendf(out, "  static const struct{ const char* name; int len; int index; } slots[%u] = {\n", size);
+    for(uint32_t slot = 0; slot < size; ++slot){
+      // names.count marks an empty slot
+      size_t index = names.count;
+      for(size_t i = 0; i < names.count; ++i){
+        if((ij_hash(names.items[i], strlen(names.items[i]), seed) & (size-1)) == slot){
+          index = i;
+        }
+      }
+      if(index < names.count){
+        nob_sb_appendf(out, "    { \"%s\", %zu, %zu },\n",
+            names.items[index], strlen(names.items[index]), index);
+      }else{
+        nob_sb_appendf(out, "    { \"\", -1, -1 },\n");
+      }
+    }
+    nob_sb_appendf(out, "  };\n");
+    nob_sb_appendf(out, "  int slot = ij_hash(key, len, %uu) & %u;\n", seed, size-1);
+    nob_sb_appendf(out, "  if(slots[slot].len != len) return -1;\n");
+    nob_sb_appendf(out, "  if(memcmp(slots[slot].name, key, len) != 0) return -1;\n");
+    nob_sb_appendf(out, "  return slots[slot].index;\n");
+    nob_sb_appendf(out, "}\n\n");
+
+    nob_da_free(names);
+  }
 
+  nob_sb_free(in);
+  return true;
+}
+
+// writes test.main.c, which includes every source, the member lookups
+// for their IJ_MEMBER_SETs and a main calling each utest_ function
+bool compile_tests(const char** sources, size_t count){
   Nob_String_Builder out = {0};
-  nob_sb_append_cstr(&out, "#include \"test.c\"\n");
+  for(size_t i = 0; i < count; ++i){
+    nob_sb_appendf(&out, "#include \"%s\"\n", sources[i]);
+  }
   nob_sb_append_cstr(&out, "\n");
+  for(size_t i = 0; i < count; ++i){
+    if(!generate_member_sets(sources[i], &out)) return false;
+  }
   nob_sb_append_cstr(&out, "int main(void){\n");
 
   const char* pattern = "utest_";
-
-  while(s < end){
-    if(strncmp(s, pattern, strlen(pattern)) == 0){
-      char* pattern_start = s;
-      while(is_letter(*s)) ++s; // take entire func name
-      nob_sb_appendf(&out, "  %.*s();\n", (int)(s-pattern_start), pattern_start);
+  for(size_t i = 0; i < count; ++i){
+    Nob_String_Builder in = {0};
+    if(!nob_read_entire_file(sources[i], &in)) return false;
+    char* end = in.items + in.count;
+    char* s = in.items;
+    while(s < end){
+      char* code = skip_non_code(s, end);
+      if(code != s){
+        s = code;
+        continue;
+      }
+      if(strncmp(s, pattern, strlen(pattern)) == 0){
+        char* pattern_start = s;
+        while(s < end && is_letter(*s)) ++s; // take entire func name
+        nob_sb_appendf(&out, "  %.*s();\n", (int)(s-pattern_start), pattern_start);
+        continue;
+      }
+      s++;
     }
-    s++;
+    nob_sb_free(in);
   }
 
   nob_sb_append_cstr(&out, "  fprintf(stderr, \"[\"GREEN\"ALL TESTS PASSED\"COLOR_RESET\"]\\n\\n\");\n");
@@ -40,16 +192,22 @@ bool compile_tests(void){
   return true;
 }
 
+// ./nob [sources...] builds and runs the tests in the given sources,
+// test.c by default
 int main(int argc, char** argv){
-  NOB_GO_REBUILD_URSELF(argc, argv);
+  NOB_GO_REBUILD_URSELF_PLUS(argc, argv, "ij.h");
 
-  if(!compile_tests()) return false;
+  nob_shift(argv, argc);
+  const char* default_sources[] = { "test.c" };
+  const char** sources = argc > 0 ? (const char**)argv : default_sources;
+  size_t count = argc > 0 ? (size_t)argc : NOB_ARRAY_LEN(default_sources);
+  if(!compile_tests(sources, count)) return 1;
 
   Cmd cmd = {0};
 
   nob_cc(&cmd);
   nob_cc_flags(&cmd);
-  cmd_append(&cmd, "-g");
+  cmd_append(&cmd, "-g", "-DIJ_THREADS", "-pthread");
   nob_cc_inputs(&cmd, "test.main.c");
   nob_cc_output(&cmd, "./test");
 
@@ -10,6 +10,9 @@
 #include "ij.h"
 
 #include <math.h>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/socket.h>
+#endif
 
 
 #define COLOR_RESET "\e[0m"
@@ -142,7 +145,137 @@ void utest_serialize_double(void){
   ij_number(&ij, &value);
   ij_deinit(&ij);
   
-  ASSERT_STREQ(buf, "123.100000");
+  ASSERT_STREQ(buf, "123.1");
+}
+
+void utest_serialize_number_shortest(void){
+  // the fewest digits that parse back to the same double, integers stay
+  // plain up to 1e21 and only tiny or huge magnitudes use an exponent
+  struct{ double value; const char* str; } cases[] = {
+    { 0.0, "0" }, { -0.0, "-0" }, { 1e-9, "1e-9" }, { 0.1, "0.1" },
+    { 0.3, "0.3" }, { 2.0/3.0, "0.6666666666666666" }, { 100.0, "100" },
+    { 1000.0, "1000" }, { 5000.0, "5000" }, { 1e15, "1000000000000000" },
+    { 1e20, "100000000000000000000" }, { 0.001, "0.001" }, { 1e-6, "0.000001" },
+    { 1e-7, "1e-7" }, { -1.2345678901234567e-6, "-0.0000012345678901234567" },
+    { 1e21, "1e21" }, { 1e300, "1e300" }, { -1.5e-7, "-1.5e-7" },
+    { 9007199254740993.0, "9007199254740992" }, { 5e-324, "5e-324" },
+    { 1.7976931348623157e308, "1.7976931348623157e308" },
+    { 2.2250738585072014e-308, "2.2250738585072014e-308" },
+  };
+  for(size_t i = 0; i < sizeof(cases)/sizeof(cases[0]); ++i){
+    char buf[64] = {0};
+    IJ ij = {0};
+    ij_init(&ij, .buf=buf, .buf_len=sizeof(buf), .serialize=true);
+    ASSERT_TRUE(ij_number(&ij, &cases[i].value));
+    ij_deinit(&ij);
+    ASSERT_STREQ(buf, cases[i].str);
+
+    double value = 0.0;
+    IJ reader = {0};
+    ij_init(&reader, .buf=buf, .serialize=false);
+    ASSERT_TRUE(ij_number(&reader, &value));
+    ASSERT_TRUE(memcmp(&value, &cases[i].value, sizeof(value)) == 0);
+  }
+}
+
+void utest_serialize_number_round_trip(void){
+  uint64_t state = 88172645463325252ULL;
+  for(int i = 0; i < 100000; ++i){
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    double value;
+    memcpy(&value, &state, sizeof(value));
+    if(isfinite(value) == false) continue;
+
+    char buf[32];
+    int len = ij_format_double(value, buf);
+    double parsed = 0.0;
+    if(ij_parse_double(buf, len, &parsed) == false
+        || memcmp(&parsed, &value, sizeof(value)) != 0
+    ){
+      ASSERT_TRUE(false);
+    }
+  }
+  ASSERT_TRUE(true);
+}
+
+void utest_serialize_number_not_finite(void){
+  char buf[64] = {0};
+  IJ ij = {0};
+  ij_init(&ij, .buf=buf, .buf_len=sizeof(buf), .serialize=true);
+  double value = INFINITY;
+  ASSERT_FALSE(ij_number(&ij, &value));
+  ASSERT_TRUE(ij_error(&ij) == IJ_E_INVALID_NUMBER);
+}
+
+void utest_serialize_integers(void){
+  char buf[1024] = {0};
+  IJ ij = {0};
+  ij_init(&ij, .buf=buf, .buf_len=sizeof(buf), .serialize=true);
+
+  int64_t min = INT64_MIN;
+  uint64_t max = UINT64_MAX;
+  int32_t small = -42;
+  int64_t zero = 0;
+  ASSERT_TRUE(ij_array_begin(&ij));
+  ASSERT_TRUE(ij_int64(&ij, &min));
+  ASSERT_TRUE(ij_uint64(&ij, &max));
+  ASSERT_TRUE(ij_int32(&ij, &small));
+  ASSERT_TRUE(ij_int64(&ij, &zero));
+  ASSERT_TRUE(ij_array_end(&ij, NULL));
+  ij_deinit(&ij);
+
+  ASSERT_STREQ(buf, "[-9223372036854775808,18446744073709551615,-42,0]");
+}
+
+void utest_serialize_string_escapes(void){
+  char buf[1024] = {0};
+  IJ ij = {0};
+  ij_init(&ij, .buf=buf, .buf_len=sizeof(buf), .serialize=true);
+
+  const char* str = "say \"hi\"\\\n\t\x01 and a long clean run of text before \"\xc3\xa9";
+  ASSERT_TRUE(ij_obj_begin(&ij));
+  ASSERT_TRUE(ij_member(&ij, "a\"b"));
+  ASSERT_TRUE(ij_string(&ij, &str));
+  ASSERT_TRUE(ij_obj_end(&ij));
+  ij_deinit(&ij);
+
+  ASSERT_STREQ(buf, "{\"a\\\"b\":\"say \\\"hi\\\"\\\\\\n\\t\\u0001"
+      " and a long clean run of text before \\\"\xc3\xa9\"}");
+}
+
+void utest_serialize_string_ascii(void){
+  char buf[1024] = {0};
+  IJ ij = {0};
+  ij_init(&ij, .buf=buf, .buf_len=sizeof(buf), .serialize=true, .ascii=true);
+
+  // é, €, an emoji outside the BMP and a stray continuation byte
+  const char* str = "caf\xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80 \x80!";
+  ASSERT_TRUE(ij_string(&ij, &str));
+  ij_deinit(&ij);
+
+  ASSERT_STREQ(buf, "\"caf\\u00e9 \\u20ac \\ud83d\\ude00 \\ufffd!\"");
+}
+
+void utest_serialize_decimal(void){
+  char buf[1024] = {0};
+  IJ ij = {0};
+  ij_init(&ij, .buf=buf, .buf_len=sizeof(buf), .serialize=true);
+
+  int64_t price = 1999;
+  int64_t small = -5;
+  int64_t whole = 42;
+  int64_t min = INT64_MIN;
+  ASSERT_TRUE(ij_array_begin(&ij));
+  ASSERT_TRUE(ij_decimal(&ij, &price, 2));
+  ASSERT_TRUE(ij_decimal(&ij, &small, 2));
+  ASSERT_TRUE(ij_decimal(&ij, &whole, 0));
+  ASSERT_TRUE(ij_decimal(&ij, &min, 18));
+  ASSERT_TRUE(ij_array_end(&ij, NULL));
+  ij_deinit(&ij);
+
+  ASSERT_STREQ(buf, "[19.99,-0.05,42,-9.223372036854775808]");
 }
 
 void utest_serialize_string(void){
@@ -188,7 +321,7 @@ void utest_serialize_any_number(void){
 
   ij_deinit(&ij);
   
-  ASSERT_STREQ(buf, "1.000000");
+  ASSERT_STREQ(buf, "1");
 }
 
 void utest_serialize_any_bool_true(void){
@@ -349,7 +482,7 @@ void utest_serialize_array_static(void){
   ij_array_end(&ij, NULL);
 
   ij_deinit(&ij);
-  ASSERT_STREQ(buf, "[1.000000,2.000000]");
+  ASSERT_STREQ(buf, "[1,2]");
 }
 
 void utest_serialize_array_dynamic(void){
@@ -371,7 +504,7 @@ void utest_serialize_array_dynamic(void){
     ij_number(&ij, &da.items[da.count-1]);
   }while(ij_array_end(&ij, &da.count) == false);
   ij_deinit(&ij);
-  ASSERT_STREQ(buf, "[2.000000,1.000000]");
+  ASSERT_STREQ(buf, "[2,1]");
   nob_da_free(da);
 }
 
@@ -422,7 +555,7 @@ void utest_serialize_obj_static(void){
 
   ij_deinit(&ij);
 
-  ASSERT_STREQ(buf, "{\"A\":1.000000,\"B\":2.000000}");
+  ASSERT_STREQ(buf, "{\"A\":1,\"B\":2}");
 }
 
 void utest_serialize_obj_dynamic(void){
@@ -443,7 +576,7 @@ void utest_serialize_obj_dynamic(void){
     }
   } while(!ij_obj_end(&ij));
 
-  ASSERT_STREQ(buf, "{\"1\":1.000000,\"2\":2.000000}");
+  ASSERT_STREQ(buf, "{\"1\":1,\"2\":2}");
 
   ij_deinit(&ij);
 }
@@ -502,6 +635,56 @@ void utest_serialize_buffer_full_string(void){
   ij_deinit(&ij);
 }
 
+// libc allocator that counts the blocks it hands out
+void* test_realloc(void* ctx, void* ptr, size_t old_size, size_t new_size){
+  int* live = ctx;
+  if(ptr == NULL) (*live)++;
+  if(new_size == 0) (*live)--;
+  return ij_libc_realloc(NULL, ptr, old_size, new_size);
+}
+
+void utest_serialize_buffer_grow(void){
+  char buf[2] = {0};
+  int live = 0;
+  IJ ij = {0};
+  ij_init(&ij, .buf=buf, .buf_len=sizeof(buf),
+      .allocator = { .ctx = &live, .realloc = test_realloc },
+      .serialize=true);
+
+  const char* value = "a string that does not fit into two bytes";
+  ASSERT_TRUE(ij_array_begin(&ij));
+  ASSERT_TRUE(ij_string(&ij, &value));
+  ASSERT_TRUE(ij_null(&ij));
+  ASSERT_TRUE(ij_array_end(&ij, NULL));
+  ASSERT_TRUE(ij_deinit(&ij));
+
+  ASSERT_TRUE(ij_buf(&ij) != buf);
+  ASSERT_STREQ(ij_buf(&ij), "[\"a string that does not fit into two bytes\",null]");
+  ASSERT_TRUE(live == 1);
+  test_realloc(&live, ij_buf(&ij), 0, 0);
+  ASSERT_TRUE(live == 0);
+}
+
+void utest_serialize_buffer_allocated(void){
+  int live = 0;
+  IJ ij = {0};
+  ASSERT_TRUE(ij_init(&ij,
+      .allocator = { .ctx = &live, .realloc = test_realloc },
+      .serialize=true));
+
+  ASSERT_TRUE(ij_obj_begin(&ij));
+  for(int i = 0; i < 200; ++i){
+    ASSERT_TRUE(ij_member(&ij, "member"));
+    ASSERT_TRUE(ij_null(&ij));
+  }
+  ASSERT_TRUE(ij_obj_end(&ij));
+  ASSERT_TRUE(ij_deinit(&ij));
+
+  ASSERT_TRUE(strlen(ij_buf(&ij)) == 2+200*strlen("\"member\":null,")-1);
+  test_realloc(&live, ij_buf(&ij), 0, 0);
+  ASSERT_TRUE(live == 0);
+}
+
 void utest_serialize_buffer_write(void){
   char tmp[6] = {0};
   char buf[256] = {0};
@@ -525,6 +708,81 @@ void utest_serialize_buffer_write(void){
   ASSERT_STREQ(buf, "[\"test1\",\"test2\",\"test3\"]");
 }
 
+void write_nested_strings(IJ* ij){
+  char str[101];
+  memset(str, 'x', 100);
+  str[100] = '\0';
+  for(int i = 0; i < 20; ++i){
+    ij_obj_begin(ij);
+    ij_member(ij, "key_spanning_more_than_the_buffer");
+  }
+  ij_write_string(ij, str);
+  for(int i = 0; i < 20; ++i){
+    ij_obj_end(ij);
+  }
+}
+
+void utest_serialize_appendf_large(void){
+  // formatted text has no size limit, in a growing buffer or a stream
+  // whose buffer is smaller than the text
+  char str[2001];
+  memset(str, 'x', 2000);
+  str[2000] = '\0';
+
+  IJ ij = {0};
+  ij_init(&ij, .serialize=true, .allocator={ .realloc=ij_libc_realloc });
+  bool ok = ij_sb_appendf(&ij.sb, "%s%d", str, 42);
+  ASSERT_TRUE(ok);
+  ASSERT_TRUE(ij_deinit(&ij));
+  ASSERT_TRUE(strlen(ij_buf(&ij)) == 2002);
+  ASSERT_TRUE(strcmp(ij_buf(&ij)+2000, "42") == 0);
+  ij_libc_realloc(NULL, ij_buf(&ij), 0, 0);
+
+  char tmp[6] = {0};
+  char streamed[4096] = {0};
+  int live = 0;
+  ij_init(&ij, .buf=tmp, .buf_len=sizeof(tmp),
+      .stream={ .write=test_write, .ctx=streamed },
+      .allocator={ .ctx=&live, .realloc=test_realloc }, .serialize=true);
+  ok = ij_sb_appendf(&ij.sb, "%d", 1234) && ij_sb_appendf(&ij.sb, "%s", str);
+  ASSERT_TRUE(ok);
+  ij_deinit(&ij);
+  ASSERT_TRUE(strlen(streamed) == 2004);
+  ASSERT_TRUE(strncmp(streamed, "1234xxx", 7) == 0);
+  ASSERT_TRUE(live == 0);
+
+  // without an allocator there is nowhere to put the text
+  memset(streamed, 0, sizeof(streamed));
+  ij_init(&ij, .buf=tmp, .buf_len=sizeof(tmp),
+      .stream={ .write=test_write, .ctx=streamed }, .serialize=true);
+  ok = ij_sb_appendf(&ij.sb, "%s", str);
+  ASSERT_FALSE(ok);
+  ASSERT_TRUE(ij_error(&ij) == IJ_E_BUF_FULL);
+  ij_deinit(&ij);
+}
+
+void utest_serialize_buffer_write_spans(void){
+  // strings and indentation longer than the buffer are flushed in pieces
+  char tmp[6] = {0};
+  char streamed[4096] = {0};
+  IJ ij = {0};
+  ij_init(&ij, .buf=tmp, .buf_len=sizeof(tmp),
+      .stream={ .write=test_write, .ctx=streamed },
+      .serialize=true, .pretty=true);
+  write_nested_strings(&ij);
+  ij_deinit(&ij);
+
+  char expected[4096] = {0};
+  IJ ref = {0};
+  ij_init(&ref, .buf=expected, .buf_len=sizeof(expected),
+      .serialize=true, .pretty=true);
+  write_nested_strings(&ref);
+  ASSERT_TRUE(ij_deinit(&ref));
+
+  ASSERT_TRUE(strlen(expected) > 100+20*40);
+  ASSERT_STREQ(streamed, expected);
+}
+
 void utest_deserialize_null(void){
   char buf[1024] = "null";
   IJ ij = {0};
@@ -572,165 +830,1654 @@ void utest_deserialize_double(void){
   ij_deinit(&ij);
 }
 
-void utest_deserialize_string(void){
-  char buf[1024] = "\"test\"";
+void utest_deserialize_double_exponent(void){
+  char buf[1024] = "[1e-7,-2.5E+3,6.02214076e23]";
   IJ ij = {0};
   ij_init(&ij, .buf=buf, .serialize=false);
-  
-  const char* str = NULL;
-  ASSERT_TRUE(ij_string(&ij, &str));
-  ASSERT_STREQ(str, "test");
+
+  double value = 0.0f;
+  ASSERT_TRUE(ij_array_begin(&ij));
+  ASSERT_TRUE(ij_number(&ij, &value));
+  ASSERT_TRUE(value == 1e-7);
+  ASSERT_TRUE(ij_number(&ij, &value));
+  ASSERT_TRUE(value == -2.5e3);
+  ASSERT_TRUE(ij_number(&ij, &value));
+  ASSERT_TRUE(value == 6.02214076e23);
+  ASSERT_TRUE(ij_array_end(&ij, NULL));
 
   ij_deinit(&ij);
 }
 
-void utest_deserialize_array_empty(void){
-  char buf[1024] = "[]";
+void utest_deserialize_double_correctly_rounded(void){
+  const char* cases[] = {
+    "0.1",
+    "2.2250738585072011e-308",
+    "4.9e-324",
+    "1.7976931348623157e308",
+    "9007199254740993",
+    "3.14159265358979323846264338327950288",
+    "1.00000000000000011102230246251565404236316680908203125",
+  };
+  for(size_t i = 0; i < NOB_ARRAY_LEN(cases); ++i){
+    double value = 0.0;
+    ASSERT_TRUE(ij_parse_double(cases[i], strlen(cases[i]), &value));
+    ASSERT_TRUE(value == strtod(cases[i], NULL));
+  }
+}
+
+void utest_deserialize_double_long_mantissa(void){
+  // halfway cases that only the big decimal fallback can decide, the last
+  // one has its deciding digit past the 768 digits that are kept
+  static char beyond[900];
+  memset(beyond, 0, sizeof(beyond));
+  strcpy(beyond, "1.00000000000000011102230246251565404236316680908203125");
+  memset(beyond+strlen(beyond), '0', 800);
+  strcat(beyond, "1");
+  struct{ const char* str; double value; } cases[] = {
+    { "1.00000000000000011102230246251565404236316680908203124", 1.0 },
+    { "1.00000000000000011102230246251565404236316680908203126", 1.0000000000000002 },
+    { "-9007199254740993.00000000000000000000000000000000000001", -9007199254740994.0 },
+    { "9007199254740993.000000000000000000000000000000000000000", 9007199254740992.0 },
+    { beyond, 1.0000000000000002 },
+  };
+  for(size_t i = 0; i < NOB_ARRAY_LEN(cases); ++i){
+    double value = 0.0;
+    ASSERT_TRUE(ij_parse_double(cases[i].str, strlen(cases[i].str), &value));
+    ASSERT_TRUE(value == cases[i].value);
+  }
+}
+
+void utest_deserialize_double_invalid(void){
+  char buf[1024] = "-";
   IJ ij = {0};
   ij_init(&ij, .buf=buf, .serialize=false);
-  
+
+  double value = 0.0f;
+  ASSERT_FALSE(ij_number(&ij, &value));
+  ASSERT_TRUE(ij_error(&ij) == IJ_E_INVALID_NUMBER);
+
+  ij_deinit(&ij);
+}
+
+void utest_deserialize_integers(void){
+  char buf[1024] = "[9007199254740993,18446744073709551615,-2147483648]";
+  IJ ij = {0};
+  ij_init(&ij, .buf=buf, .serialize=false);
+
+  int64_t id = 0;
+  uint64_t max = 0;
+  int32_t min = 0;
   ASSERT_TRUE(ij_array_begin(&ij));
+  ASSERT_TRUE(ij_int64(&ij, &id));
+  ASSERT_TRUE(id == 9007199254740993LL);
+  ASSERT_TRUE(ij_uint64(&ij, &max));
+  ASSERT_TRUE(max == UINT64_MAX);
+  ASSERT_TRUE(ij_int32(&ij, &min));
+  ASSERT_TRUE(min == INT32_MIN);
   ASSERT_TRUE(ij_array_end(&ij, NULL));
 
   ij_deinit(&ij);
 }
 
-void utest_deserialize_obj_empty(void){
-  char buf[1024] = "{}";
+void utest_deserialize_integer_overflow(void){
+  char buf[1024] = "9223372036854775808";
   IJ ij = {0};
   ij_init(&ij, .buf=buf, .serialize=false);
-  
-  ASSERT_TRUE(ij_obj_begin(&ij));
-  ASSERT_TRUE(ij_obj_end(&ij));
+
+  int64_t value = 0;
+  ASSERT_FALSE(ij_int64(&ij, &value));
+  ASSERT_TRUE(ij_error(&ij) == IJ_E_NUMBER_OVERFLOW);
 
   ij_deinit(&ij);
 }
 
-void utest_deserialize_obj_static(void){
-  char buf[1024] = "{\"1\":1,\"2\":2}";
+void utest_deserialize_array_end_separator(void){
+  const char* docs[] = { "[1,2]", "[1 2]", "[1}" };
+  for(size_t i = 0; i < sizeof(docs)/sizeof(docs[0]); ++i){
+    char buf[64] = {0};
+    strcpy(buf, docs[i]);
+    IJ ij = {0};
+    ij_init(&ij, .buf=buf, .serialize=false);
+
+    double value = 0.0;
+    int count = 0;
+    int rounds = 0;
+    ASSERT_TRUE(ij_array_begin(&ij));
+    while(!ij_array_end(&ij, &count) && rounds++ < 10) ij_number(&ij, &value);
+    ASSERT_TRUE(rounds < 10);
+    if(i == 0){
+      ASSERT_TRUE(ij_error(&ij) == IJ_E_OK);
+      ASSERT_TRUE(count == 2);
+    }else{
+      ASSERT_TRUE(ij_error(&ij) == IJ_E_UNEXPECTED_TOKEN);
+    }
+    ij_deinit(&ij);
+  }
+
+  // ij_obj_end reporting more members does not end the array
+  char buf[64] = "[{\"a\":1,\"b\":2},{\"a\":3}]";
   IJ ij = {0};
   ij_init(&ij, .buf=buf, .serialize=false);
-  
-  double value = 0.0f;
-  
-  ASSERT_TRUE(ij_obj_begin(&ij));
+  double sum = 0.0;
+  int count = 0;
+  ASSERT_TRUE(ij_array_begin(&ij));
+  while(!ij_array_end(&ij, &count)){
+    ASSERT_TRUE(ij_obj_begin(&ij));
+    do{
+      double value = 0.0;
+      if(ij_member(&ij, "a") && ij_number(&ij, &value)) sum += value;
+    }while(!ij_obj_end(&ij));
+  }
+  ASSERT_TRUE(count == 2);
+  ASSERT_FLEQ(sum, 4.0f);
+  ij_deinit(&ij);
+}
 
-  ASSERT_TRUE(ij_member(&ij, "1"));
-  ASSERT_TRUE(ij_number(&ij, &value));
-  ASSERT_FLEQ(value, 1.0f);
-  
-  ASSERT_TRUE(ij_member(&ij, "2"));
-  ASSERT_TRUE(ij_number(&ij, &value));
-  ASSERT_FLEQ(value, 2.0f);
+void utest_deserialize_unsigned_negative(void){
+  char buf[1024] = "[-0,-1]";
+  IJ ij = {0};
+  ij_init(&ij, .buf=buf, .serialize=false);
 
-  ASSERT_TRUE(ij_obj_end(&ij));
+  uint64_t value = 1;
+  ASSERT_TRUE(ij_array_begin(&ij));
+  ASSERT_TRUE(ij_uint64(&ij, &value));
+  ASSERT_TRUE(value == 0);
+  ASSERT_FALSE(ij_uint64(&ij, &value));
+  ASSERT_TRUE(ij_error(&ij) == IJ_E_NUMBER_OVERFLOW);
 
   ij_deinit(&ij);
 }
 
-void utest_deserialize_obj_dynamic(void){
-  char buf[1024] = "{\"1\":1,\"2\":2}";
+void utest_deserialize_decimal(void){
+  char buf[1024] = "[19.99,1.5,-0.05,1.2e1,12500e-2,0.100,3]";
   IJ ij = {0};
   ij_init(&ij, .buf=buf, .serialize=false);
-  
-  double v1 = 0.0f;
-  double v2 = 0.0f;
-  
-  ASSERT_TRUE(ij_obj_begin(&ij));
-  do{
-    if(ij_member(&ij, "1")){
-      ASSERT_TRUE(ij_number(&ij, &v1));
-    }
-    if(ij_member(&ij, "2")){
-      ASSERT_TRUE(ij_number(&ij, &v2));
-    }
-  } while(!ij_obj_end(&ij));
 
-  ASSERT_FLEQ(v1, 1.0f);
-  ASSERT_FLEQ(v2, 2.0f);
+  int64_t expected[] = {1999, 150, -5, 1200, 12500, 10, 300};
+  ASSERT_TRUE(ij_array_begin(&ij));
+  for(size_t i = 0; i < sizeof(expected)/sizeof(expected[0]); ++i){
+    int64_t value = 0;
+    ASSERT_TRUE(ij_decimal(&ij, &value, 2));
+    ASSERT_TRUE(value == expected[i]);
+  }
+  ASSERT_TRUE(ij_array_end(&ij, NULL));
 
   ij_deinit(&ij);
 }
 
-void utest_deserialize_obj_consume_unhandled_members(void){
-  char buf[1024] = "{\"1\":1,\"2\":2,\"3\":3}";
+void utest_deserialize_decimal_inexact(void){
+  char buf[1024] = "0.125";
   IJ ij = {0};
   ij_init(&ij, .buf=buf, .serialize=false);
-  
-  double v2 = 0.0f;
-  int count = 0;
-  
-  ASSERT_TRUE(ij_obj_begin(&ij));
-  do{
-    if(ij_member(&ij, "2")){
-      ASSERT_TRUE(ij_number(&ij, &v2));
-    }
-    count++;
-  } while(!ij_obj_end(&ij));
 
-  ASSERT_FLEQ(v2, 2.0f);
+  int64_t value = 0;
+  ASSERT_FALSE(ij_decimal(&ij, &value, 2));
+  ASSERT_TRUE(ij_error(&ij) == IJ_E_INVALID_NUMBER);
 
   ij_deinit(&ij);
 }
 
-void utest_deserialize_number_unexpected_end_of_input(void){
-  char buf[1024] = "1.";
+void utest_deserialize_decimal_long_fraction(void){
+  // more digits than fit in 64 bits, the value itself fits the scale
+  const char* inexact = "925821784.010000000069";
+  const char* exact = "925821784.000000000000000000000";
+  int64_t value = 0;
+  ASSERT_TRUE(ij_parse_decimal(inexact, strlen(inexact), 1, &value) == IJ_E_INVALID_NUMBER);
+  ASSERT_TRUE(ij_parse_decimal(exact, strlen(exact), 1, &value) == IJ_E_OK);
+  ASSERT_TRUE(value == 9258217840LL);
+}
+
+void utest_deserialize_decimal_overflow(void){
+  char buf[1024] = "92233720368547758.08";
   IJ ij = {0};
-  ij_init(&ij, .buf=buf, .buf_len=strlen(buf), .serialize=false);
-  
-  double value = 0.0f;
-  ASSERT_FALSE(ij_number(&ij, &value));
+  ij_init(&ij, .buf=buf, .serialize=false);
 
-  ASSERT_TRUE(ij_error(&ij) == IJ_E_END_OF_INPUT);
+  int64_t value = 0;
+  ASSERT_FALSE(ij_decimal(&ij, &value, 2));
+  ASSERT_TRUE(ij_error(&ij) == IJ_E_NUMBER_OVERFLOW);
 
   ij_deinit(&ij);
 }
 
-void utest_deserialize_string_unexpected_end_of_input(void){
-  char buf[1024] = "\"test";
+void utest_decimal_round_trip(void){
+  const char* cases[] = {"0", "0.000001", "-0.000001", "123.456789",
+    "9223372036854.775807", "-9223372036854.775808", "1e-6", "0.0000010000000000"};
+  const char* formatted[] = {"0.000000", "0.000001", "-0.000001", "123.456789",
+    "9223372036854.775807", "-9223372036854.775808", "0.000001", "0.000001"};
+  for(size_t i = 0; i < sizeof(cases)/sizeof(cases[0]); ++i){
+    int64_t value = 0;
+    char out[32] = {0};
+    ASSERT_TRUE(ij_parse_decimal(cases[i], strlen(cases[i]), 6, &value) == IJ_E_OK);
+    out[ij_format_decimal(value, 6, out)] = '\0';
+    ASSERT_STREQ(out, formatted[i]);
+  }
+}
+
+void utest_deserialize_integer_fraction(void){
+  char buf[1024] = "1.5";
   IJ ij = {0};
   ij_init(&ij, .buf=buf, .serialize=false);
-  
-  ASSERT_FALSE(ij_string(&ij,NULL));
 
-  ASSERT_TRUE(ij_error(&ij) == IJ_E_END_OF_INPUT);
+  int32_t value = 0;
+  ASSERT_FALSE(ij_int32(&ij, &value));
+  ASSERT_TRUE(ij_error(&ij) == IJ_E_INVALID_NUMBER);
 
   ij_deinit(&ij);
 }
 
-void utest_deserialize_array_unexpected_end_of_input(void){
-  char buf[1024] = "[";
+void utest_deserialize_string(void){
+  char buf[1024] = "\"test\"";
   IJ ij = {0};
   ij_init(&ij, .buf=buf, .serialize=false);
   
-  ASSERT_TRUE(ij_array_begin(&ij));
-  ASSERT_TRUE(ij_array_end(&ij, NULL));
+  const char* str = NULL;
+  ASSERT_TRUE(ij_string(&ij, &str));
+  ASSERT_STREQ(str, "test");
 
-  ASSERT_TRUE(ij_error(&ij) == IJ_E_END_OF_INPUT);
+  ij_deinit(&ij);
+}
 
+void utest_deserialize_read_only(void){
+  // lives in read only memory, any write to it would crash
+  static const char doc[] = "{\"name\":\"test\",\"tags\":[\"a\",\"bc\"]}";
+  for(int pass = 0; pass < 2; ++pass){
+    IJ ij = {0};
+    ij_init(&ij, .buf=(char*)doc, .read_only=true, .serialize=false);
+
+    const char* name = NULL;
+    int len = 0;
+    char tag[4];
+    ASSERT_TRUE(ij_obj_begin(&ij));
+    ASSERT_TRUE(ij_member(&ij, "name"));
+    ASSERT_TRUE(ij_string_view(&ij, &name, &len));
+    ASSERT_TRUE(len == 4 && strncmp(name, "test", 4) == 0);
+    ASSERT_TRUE(name == doc+9);
+    ASSERT_TRUE(ij_member(&ij, "tags"));
+    ASSERT_TRUE(ij_array_begin(&ij));
+    ASSERT_TRUE(ij_string_copy(&ij, tag, sizeof(tag)));
+    ASSERT_STREQ(tag, "a");
+    ASSERT_TRUE(ij_string_copy(&ij, tag, sizeof(tag)));
+    ASSERT_STREQ(tag, "bc");
+    ASSERT_TRUE(ij_array_end(&ij, NULL));
+    ASSERT_TRUE(ij_obj_end(&ij));
+    ij_deinit(&ij);
+  }
+}
+
+void utest_deserialize_read_only_string(void){
+  static const char doc[] = "[\"test\",\"too long\"]";
+  IJ ij = {0};
+  ij_init(&ij, .buf=(char*)doc, .read_only=true, .serialize=false);
+
+  const char* str = NULL;
+  char copy[4];
+  ASSERT_TRUE(ij_array_begin(&ij));
+  ASSERT_FALSE(ij_string(&ij, &str));
+  ASSERT_TRUE(ij_error(&ij) == IJ_E_ARG_READ_ONLY);
+  ij.lexer.error = IJ_E_OK;
+  ASSERT_FALSE(ij_string_copy(&ij, copy, sizeof(copy)));
+  ASSERT_TRUE(ij_error(&ij) == IJ_E_BUF_FULL);
   ij_deinit(&ij);
 }
 
-void utest_deserialize_obj_unexpected_end_of_input(void){
-  char buf[1024] = "{";
+void utest_deserialize_string_escapes(void){
+  char buf[1024] = "{\"k\\\"ey\": [\"a\\\"b\\\\c\\/\\n\", "
+    "\"\\u00e9\\u20AC\\ud83d\\ude00\", \"\\ud800x\", \"plain\"]}";
   IJ ij = {0};
   ij_init(&ij, .buf=buf, .serialize=false);
-  
+
+  const char* str = NULL;
   ASSERT_TRUE(ij_obj_begin(&ij));
+  ASSERT_TRUE(ij_member(&ij, "k\"ey"));
+  ASSERT_TRUE(ij_array_begin(&ij));
+  ASSERT_TRUE(ij_string(&ij, &str));
+  ASSERT_STREQ(str, "a\"b\\c/\n");
+  ASSERT_TRUE(ij_string(&ij, &str));
+  ASSERT_STREQ(str, "\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80");
+  ASSERT_TRUE(ij_string(&ij, &str));
+  ASSERT_STREQ(str, "\xef\xbf\xbdx");
+  ASSERT_TRUE(ij_string(&ij, &str));
+  ASSERT_STREQ(str, "plain");
+  ASSERT_FALSE(ij.lexer.token.has_escapes);
+  ASSERT_TRUE(ij_array_end(&ij, NULL));
   ASSERT_TRUE(ij_obj_end(&ij));
 
-  ASSERT_TRUE(ij_error(&ij) == IJ_E_END_OF_INPUT);
-
   ij_deinit(&ij);
 }
 
-void utest_deserialize_string_stream_lifetime_error(void){
-  char in[] = "[\"str1\",\"str2\",\"str3\"]";
-  char* in_p = in;
-  char buf[8];
+void utest_deserialize_string_escapes_index(void){
+  char buf[1024] = "[\"say \\\"hi\\\"\", \"\\\\\"]";
+  uint32_t index[256];
   IJ ij = {0};
-  ij_init(&ij, .buf=buf, .buf_len=sizeof(buf), 
-      .stream = {
+  ij_init(&ij, .buf=buf, .index=index, .index_len=256, .serialize=false);
+  ASSERT_TRUE(ij.lexer.index != NULL);
+
+  const char* str = NULL;
+  ASSERT_TRUE(ij_array_begin(&ij));
+  ASSERT_TRUE(ij_string(&ij, &str));
+  ASSERT_STREQ(str, "say \"hi\"");
+  ASSERT_TRUE(ij_string(&ij, &str));
+  ASSERT_STREQ(str, "\\");
+  ASSERT_TRUE(ij_array_end(&ij, NULL));
+
+  ij_deinit(&ij);
+}
+
+void utest_deserialize_string_escapes_stream(void){
+  // the backslash of every escape lands on a different buffer position
+  char in[] = "[\"\\\"1\\\"23\\\"456\\\"7\\\\\\u0041\"]";
+  char* in_p = in;
+  char buf[8] = {0};
+  IJ ij = {0};
+  ij_init(&ij, .buf=buf, .buf_len=sizeof(buf),
+      .stream = {
+        .ctx = &in_p,
+        .read = test_read,
+      },
+      .allocator = { .realloc = ij_libc_realloc },
+      .serialize=false);
+
+  const char* str = NULL;
+  ASSERT_TRUE(ij_array_begin(&ij));
+  ASSERT_TRUE(ij_string(&ij, &str));
+  ASSERT_STREQ(str, "\"1\"23\"456\"7\\A");
+  ASSERT_TRUE(ij_array_end(&ij, NULL));
+
+  ij_deinit(&ij);
+}
+
+void utest_deserialize_string_invalid_escape(void){
+  char buf[1024] = "[\"bad \\x escape\"]";
+  IJ ij = {0};
+  ij_init(&ij, .buf=buf, .serialize=false);
+
+  const char* str = NULL;
+  ASSERT_TRUE(ij_array_begin(&ij));
+  ASSERT_FALSE(ij_string(&ij, &str));
+  ASSERT_TRUE(ij_error(&ij) == IJ_E_INVALID_STRING);
+
+  ij_deinit(&ij);
+}
+
+void utest_deserialize_read_only_escapes(void){
+  static const char doc[] = "[\"tab\\there\"]";
+  IJ ij = {0};
+  ij_init(&ij, .buf=(char*)doc, .read_only=true, .serialize=false);
+
+  char copy[16];
+  ASSERT_TRUE(ij_array_begin(&ij));
+  ASSERT_TRUE(ij_string_copy(&ij, copy, sizeof(copy)));
+  ASSERT_STREQ(copy, "tab\there");
+  ASSERT_TRUE(ij_array_end(&ij, NULL));
+  ij_deinit(&ij);
+}
+
+void utest_string_escapes_round_trip(void){
+  char buf[1024] = {0};
+  IJ ij = {0};
+  ij_init(&ij, .buf=buf, .buf_len=sizeof(buf), .serialize=true, .ascii=true);
+  const char* str = "\"quoted\" \\ \x01\n caf\xc3\xa9 \xf0\x9f\x98\x80";
+  ASSERT_TRUE(ij_string(&ij, &str));
+  ij_deinit(&ij);
+
+  const char* read = NULL;
+  ij_init(&ij, .buf=buf, .serialize=false);
+  ASSERT_TRUE(ij_string(&ij, &read));
+  ASSERT_STREQ(read, str);
+  ij_deinit(&ij);
+}
+
+void utest_serialize_string_view(void){
+  char buf[1024] = {0};
+  IJ ij = {0};
+  ij_init(&ij, .buf=buf, .buf_len=sizeof(buf), .serialize=true);
+
+  const char* str = "test and more";
+  int len = 4;
+  ASSERT_TRUE(ij_string_view(&ij, &str, &len));
+  ij_deinit(&ij);
+
+  ASSERT_STREQ(buf, "\"test\"");
+}
+
+void utest_deserialize_whitespace(void){
+  char buf[1024] = "{\r\n"
+    "                                        \"1\"\t:\t1,\n"
+    "\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\"2\" : 2\r\n"
+    "}";
+  IJ ij = {0};
+  ij_init(&ij, .buf=buf, .serialize=false);
+
+  double value = 0.0f;
+
+  ASSERT_TRUE(ij_obj_begin(&ij));
+  ASSERT_TRUE(ij_member(&ij, "1"));
+  ASSERT_TRUE(ij_number(&ij, &value));
+  ASSERT_FLEQ(value, 1.0f);
+  ASSERT_TRUE(ij_member(&ij, "2"));
+  ASSERT_TRUE(ij_number(&ij, &value));
+  ASSERT_FLEQ(value, 2.0f);
+  ASSERT_TRUE(ij_obj_end(&ij));
+
+  ij_deinit(&ij);
+}
+
+void utest_deserialize_whitespace_stream(void){
+  char in[] = "[\n                                      \"str\"\r\n\t\t\t]";
+  char* in_p = in;
+  char buf[8] = {0};
+  IJ ij = {0};
+  ij_init(&ij, .buf=buf, .buf_len=sizeof(buf),
+      .stream = {
+        .ctx = &in_p,
+        .read = test_read,
+      },
+      .serialize=false);
+
+  const char* str = NULL;
+  ASSERT_TRUE(ij_array_begin(&ij));
+  ASSERT_TRUE(ij_string(&ij, &str));
+  ASSERT_STREQ(str, "str");
+  ASSERT_TRUE(ij_array_end(&ij, NULL));
+
+  ij_deinit(&ij);
+}
+
+void utest_deserialize_stream_buffer_grow(void){
+  char in[] = "[\"a string that is much longer than the buffer\", 12345678901234, true]";
+  char* in_p = in;
+  char buf[8] = {0};
+  int live = 0;
+  IJ ij = {0};
+  ij_init(&ij, .buf=buf, .buf_len=sizeof(buf),
+      .stream = {
+        .ctx = &in_p,
+        .read = test_read,
+      },
+      .allocator = { .ctx = &live, .realloc = test_realloc },
+      .serialize=false);
+
+  const char* str = NULL;
+  int64_t i = 0;
+  bool b = false;
+  ASSERT_TRUE(ij_array_begin(&ij));
+  ASSERT_TRUE(ij_string(&ij, &str));
+  ASSERT_STREQ(str, "a string that is much longer than the buffer");
+  ASSERT_TRUE(ij_int64(&ij, &i));
+  ASSERT_TRUE(i == 12345678901234);
+  ASSERT_TRUE(ij_bool(&ij, &b));
+  ASSERT_TRUE(b);
+  ASSERT_TRUE(ij_array_end(&ij, NULL));
+  ASSERT_TRUE(ij.lexer.owns_buf);
+
+  ij_deinit(&ij);
+  ASSERT_TRUE(live == 0);
+}
+
+void utest_deserialize_stream_buffer_full(void){
+  char in[] = "[\"a string that is much longer than the buffer\"]";
+  char* in_p = in;
+  char buf[8] = {0};
+  IJ ij = {0};
+  ij_init(&ij, .buf=buf, .buf_len=sizeof(buf),
+      .stream = {
+        .ctx = &in_p,
+        .read = test_read,
+      },
+      .serialize=false);
+
+  const char* str = NULL;
+  ASSERT_TRUE(ij_array_begin(&ij));
+  ASSERT_FALSE(ij_string(&ij, &str));
+  ASSERT_TRUE(ij_error(&ij) == IJ_E_BUF_FULL);
+
+  ij_deinit(&ij);
+}
+
+void utest_deserialize_string_long(void){
+  char buf[1024] = "\"Lorem ipsum dolor sit amet, consectetur adipiscing elit, "
+    "sed do eiusmod tempor incididunt ut labore et dolore magna aliqua\"";
+  IJ ij = {0};
+  ij_init(&ij, .buf=buf, .serialize=false);
+
+  const char* str = NULL;
+  ASSERT_TRUE(ij_string(&ij, &str));
+  ASSERT_STREQ(str, "Lorem ipsum dolor sit amet, consectetur adipiscing elit, "
+    "sed do eiusmod tempor incididunt ut labore et dolore magna aliqua");
+
+  ij_deinit(&ij);
+}
+
+void utest_deserialize_string_long_stream(void){
+  char in[] = "[\"abcdefghijklmnopqrstuvwxyz\",\"ABCDEFGHIJKLMNOPQRSTUVWXYZ\"]";
+  char* in_p = in;
+  char buf[40] = {0};
+  IJ ij = {0};
+  ij_init(&ij, .buf=buf, .buf_len=sizeof(buf),
+      .stream = {
+        .ctx = &in_p,
+        .read = test_read,
+      },
+      .serialize=false);
+
+  const char* str = NULL;
+  ASSERT_TRUE(ij_array_begin(&ij));
+  ASSERT_TRUE(ij_string(&ij, &str));
+  ASSERT_STREQ(str, "abcdefghijklmnopqrstuvwxyz");
+  ASSERT_TRUE(ij_string(&ij, &str));
+  ASSERT_STREQ(str, "ABCDEFGHIJKLMNOPQRSTUVWXYZ");
+  ASSERT_TRUE(ij_array_end(&ij, NULL));
+
+  ij_deinit(&ij);
+}
+
+void utest_deserialize_index(void){
+  char buf[1024] = "{\n"
+    "  \"name\": \"a string with {braces}, [brackets] and: colons\",\n"
+    "  \"list\": [ true , false , null ],\n"
+    "  \"value\": 42\n"
+    "}";
+  uint32_t index[256];
+  IJ ij = {0};
+  ij_init(&ij, .buf=buf, .index=index, .index_len=256, .serialize=false);
+  ASSERT_TRUE(ij.lexer.index != NULL);
+
+  const char* name = NULL;
+  bool b = false;
+  double value = 0.0f;
+
+  ASSERT_TRUE(ij_obj_begin(&ij));
+  ASSERT_TRUE(ij_member(&ij, "name"));
+  ASSERT_TRUE(ij_string(&ij, &name));
+  ASSERT_STREQ(name, "a string with {braces}, [brackets] and: colons");
+  ASSERT_TRUE(ij_member(&ij, "list"));
+  ASSERT_TRUE(ij_array_begin(&ij));
+  ASSERT_TRUE(ij_bool(&ij, &b));
+  ASSERT_TRUE(b);
+  ASSERT_TRUE(ij_bool(&ij, &b));
+  ASSERT_FALSE(b);
+  ASSERT_TRUE(ij_null(&ij));
+  ASSERT_TRUE(ij_array_end(&ij, NULL));
+  ASSERT_TRUE(ij_member(&ij, "value"));
+  ASSERT_TRUE(ij_number(&ij, &value));
+  ASSERT_FLEQ(value, 42.0f);
+  ASSERT_TRUE(ij_obj_end(&ij));
+
+  ij_deinit(&ij);
+}
+
+void utest_deserialize_index_too_small(void){
+  char buf[1024] = "[\"str\"]";
+  uint32_t index[2];
+  IJ ij = {0};
+  ij_init(&ij, .buf=buf, .index=index, .index_len=2, .serialize=false);
+  ASSERT_TRUE(ij.lexer.index == NULL);
+
+  const char* str = NULL;
+  ASSERT_TRUE(ij_array_begin(&ij));
+  ASSERT_TRUE(ij_string(&ij, &str));
+  ASSERT_STREQ(str, "str");
+  ASSERT_TRUE(ij_array_end(&ij, NULL));
+
+  ij_deinit(&ij);
+}
+
+void utest_deserialize_file(void){
+  const char* path = "test_file.json";
+  const char* doc = "{\"name\":\"test\",\"value\":42}";
+  ASSERT_TRUE(nob_write_entire_file(path, doc, strlen(doc)));
+
+  IJ ij = {0};
+  ASSERT_TRUE(ij_init_file(&ij, path, .read_only=true));
+
+  const char* name = NULL;
+  int len = 0;
+  double value = 0.0f;
+  ASSERT_TRUE(ij_obj_begin(&ij));
+  ASSERT_TRUE(ij_member(&ij, "name"));
+  ASSERT_TRUE(ij_string_view(&ij, &name, &len));
+  ASSERT_TRUE(len == 4 && strncmp(name, "test", 4) == 0);
+  ASSERT_TRUE(ij_member(&ij, "value"));
+  ASSERT_TRUE(ij_number(&ij, &value));
+  ASSERT_FLEQ(value, 42.0f);
+  ASSERT_TRUE(ij_obj_end(&ij));
+  ij_deinit(&ij);
+
+  remove(path);
+}
+
+void utest_deserialize_file_page_sized(void){
+  // ends on a page boundary on most systems, the terminator then comes
+  // from the page after the file
+  const char* path = "test_file.json";
+  char doc[4096];
+  memset(doc, ' ', sizeof(doc));
+  memcpy(doc, "[\"str\"", 6);
+  doc[sizeof(doc)-1] = ']';
+  ASSERT_TRUE(nob_write_entire_file(path, doc, sizeof(doc)));
+
+  IJ ij = {0};
+  ASSERT_TRUE(ij_init_file(&ij, path));
+
+  const char* str = NULL;
+  ASSERT_TRUE(ij_array_begin(&ij));
+  ASSERT_TRUE(ij_string(&ij, &str));
+  ASSERT_STREQ(str, "str");
+  ASSERT_TRUE(ij_array_end(&ij, NULL));
+  ij_deinit(&ij);
+
+  remove(path);
+}
+
+void utest_deserialize_file_missing(void){
+  IJ ij = {0};
+  ASSERT_FALSE(ij_init_file(&ij, "does_not_exist.json"));
+  ASSERT_TRUE(ij_error(&ij) == IJ_E_FILE_FAILURE);
+}
+
+typedef struct{
+  int64_t sums[4];
+  int64_t records[4];
+  size_t batches[8192];
+  size_t batch_count;
+} ParallelTotals;
+
+bool ndjson_sum_record(void* ctx, IJ* ij, int worker, size_t offset){
+  (void)offset;
+  ParallelTotals* totals = ctx;
+  int64_t id = 0;
+  int64_t value = 0;
+  bool ok = ij_obj_begin(ij)
+    && ij_member(ij, "id") && ij_int64(ij, &id)
+    && ij_member(ij, "value") && ij_int64(ij, &value)
+    && ij_obj_end(ij);
+  if(ok == false || value != id*2) return false;
+  totals->sums[worker] += value;
+  totals->records[worker]++;
+  return true;
+}
+
+bool ndjson_sum_batch(void* ctx, int worker, size_t batch){
+  (void)worker;
+  ParallelTotals* totals = ctx;
+  if(totals->batch_count >= 8192) return false;
+  totals->batches[totals->batch_count++] = batch;
+  return true;
+}
+
+void utest_deserialize_ndjson(void){
+  char buf[4096] = {0};
+  int len = 0;
+  int64_t expected = 0;
+  for(int i = 0; i < 100; ++i){
+    len += sprintf(buf+len, "{\"id\":%d,\"value\":%d}\n", i, i*2);
+    if(i % 10 == 0) len += sprintf(buf+len, "\n");
+    expected += i*2;
+  }
+
+  ParallelTotals totals = {0};
+  IJ_Error error = ij_ndjson(buf, 0,
+      .record=ndjson_sum_record, .batch=ndjson_sum_batch, .ctx=&totals,
+      .threads=4, .batch_size=128, .ordered=true);
+  ASSERT_TRUE(error == IJ_E_OK);
+
+  int64_t sum = 0;
+  int64_t records = 0;
+  for(int i = 0; i < 4; ++i){
+    sum += totals.sums[i];
+    records += totals.records[i];
+  }
+  ASSERT_TRUE(sum == expected);
+  ASSERT_TRUE(records == 100);
+  ASSERT_TRUE(totals.batch_count == ((size_t)len+127)/128);
+  for(size_t i = 0; i < totals.batch_count; ++i){
+    ASSERT_TRUE(totals.batches[i] == i);
+  }
+}
+
+void utest_deserialize_ndjson_invalid(void){
+  char buf[] = "{\"id\":1,\"value\":2}\n{\"id\":2,\"value\":]}\n{\"id\":3,\"value\":6}";
+  ParallelTotals totals = {0};
+  IJ_Error error = ij_ndjson(buf, 0, .record=ndjson_sum_record, .ctx=&totals,
+      .threads=2, .batch_size=16);
+  ASSERT_TRUE(error == IJ_E_UNEXPECTED_TOKEN);
+}
+
+void utest_deserialize_ndjson_trailing(void){
+  const char* docs[] = {
+    "{\"id\":1,\"value\":2} garbage\n{\"id\":2,\"value\":4}",
+    "{\"id\":1,\"value\":2} {\"id\":3,\"value\":6}\n",
+    "{\"id\":1,\"value\":2}\n{\"id\":2,\"value\":4} 1",
+  };
+  for(size_t i = 0; i < sizeof(docs)/sizeof(docs[0]); ++i){
+    char buf[128];
+    strcpy(buf, docs[i]);
+    ParallelTotals totals = {0};
+    IJ_Error error = ij_ndjson(buf, 0, .record=ndjson_sum_record, .ctx=&totals);
+    ASSERT_TRUE(error == IJ_E_UNEXPECTED_TOKEN);
+  }
+
+  char buf[] = "{\"id\":1,\"value\":2} \t\r\n{\"id\":2,\"value\":4}  ";
+  ParallelTotals totals = {0};
+  ASSERT_TRUE(ij_ndjson(buf, 0, .record=ndjson_sum_record, .ctx=&totals) == IJ_E_OK);
+  ASSERT_TRUE(totals.records[0] == 2);
+}
+
+void utest_deserialize_ndjson_file(void){
+  // blank lines, crlf and no newline after the last record
+  const char* path = "test_file.json";
+  const char* doc = "{\"id\":1,\"value\":2}\r\n\n  \n{\"id\":2,\"value\":4}\n{\"id\":3,\"value\":6}";
+  ASSERT_TRUE(nob_write_entire_file(path, doc, strlen(doc)));
+
+  ParallelTotals totals = {0};
+  IJ_Error error = ij_ndjson_file(path, .record=ndjson_sum_record, .ctx=&totals,
+      .threads=1, .opts={ .read_only=true });
+  ASSERT_TRUE(error == IJ_E_OK);
+  ASSERT_TRUE(totals.sums[0] == 12);
+  ASSERT_TRUE(totals.records[0] == 3);
+
+  remove(path);
+}
+
+bool array_sum_element(void* ctx, IJ* ij, int worker, size_t offset){
+  (void)offset;
+  ParallelTotals* totals = ctx;
+  int64_t id = 0;
+  int64_t value = 0;
+  bool ok = ij_obj_begin(ij)
+    && ij_member(ij, "id") && ij_int64(ij, &id)
+    && ij_member(ij, "s") && ij_skip_value(ij)
+    && ij_member(ij, "n") && ij_skip_value(ij)
+    && ij_member(ij, "value") && ij_int64(ij, &value)
+    && ij_obj_end(ij);
+  if(ok == false || value != id*2) return false;
+  totals->sums[worker] += value;
+  totals->records[worker]++;
+  return true;
+}
+
+void utest_deserialize_parallel_array(void){
+  // strings and nested values with commas, brackets and escapes, cut at
+  // every byte with a batch size of 1
+  size_t batch_sizes[] = { 64, 7, 1 };
+  for(size_t b = 0; b < sizeof(batch_sizes)/sizeof(batch_sizes[0]); ++b){
+    char buf[8192] = {0};
+    int len = sprintf(buf, " [\n");
+    int64_t expected = 0;
+    for(int i = 0; i < 100; ++i){
+      len += sprintf(buf+len, "%s{\"id\":%d,\"s\":\"x,]\\\\[{y\",\"n\":[1,[2,{\"a\":\"}\"}]],\"value\":%d}",
+          i > 0 ? ",\n" : "", i, i*2);
+      expected += i*2;
+    }
+    len += sprintf(buf+len, "\n] ");
+
+    ParallelTotals totals = {0};
+    IJ_Error error = ij_parallel_array(buf, 0,
+        .record=array_sum_element, .batch=ndjson_sum_batch, .ctx=&totals,
+        .threads=4, .batch_size=batch_sizes[b], .ordered=true);
+    ASSERT_TRUE(error == IJ_E_OK);
+
+    int64_t sum = 0;
+    int64_t records = 0;
+    for(int i = 0; i < 4; ++i){
+      sum += totals.sums[i];
+      records += totals.records[i];
+    }
+    ASSERT_TRUE(sum == expected);
+    ASSERT_TRUE(records == 100);
+    ASSERT_TRUE(totals.batch_count == ((size_t)len+batch_sizes[b]-1)/batch_sizes[b]);
+    for(size_t i = 0; i < totals.batch_count; ++i){
+      ASSERT_TRUE(totals.batches[i] == i);
+    }
+  }
+}
+
+void utest_deserialize_parallel_array_empty(void){
+  char buf[] = " [ ] ";
+  ParallelTotals totals = {0};
+  ASSERT_TRUE(ij_parallel_array(buf, 0, .record=array_sum_element, .ctx=&totals,
+        .batch_size=2) == IJ_E_OK);
+  ASSERT_TRUE(totals.records[0] == 0);
+}
+
+// counts live blocks like test_realloc but fails the first allocation
+void* test_realloc_fail_first(void* ctx, void* ptr, size_t old_size, size_t new_size){
+  int* live = ctx;
+  if(ptr == NULL && live[1]++ == 0) return NULL;
+  return test_realloc(ctx, ptr, old_size, new_size);
+}
+
+void utest_deserialize_parallel_alloc_failure(void){
+  char buf[] = "[1,2,3]";
+  int live[2] = {0};
+  ParallelTotals totals = {0};
+  IJ_Error error = ij_parallel_array(buf, 0, .record=array_sum_element, .ctx=&totals,
+      .opts={ .allocator={ .ctx=live, .realloc=test_realloc_fail_first } });
+  ASSERT_TRUE(error == IJ_E_ALLOC_FAILURE);
+  ASSERT_TRUE(live[0] == 0);
+}
+
+void utest_deserialize_parallel_array_invalid(void){
+  const char* docs[] = {
+    "{\"id\":1}",
+    "[{\"id\":0,\"s\":\"\",\"n\":0,\"value\":0},]",
+    "[{\"id\":0,\"s\":\"\",\"n\":0,\"value\":0} 1]",
+    "[{\"id\":0,\"s\":\"\",\"n\":0,\"value\":0},[]",
+    "[{\"id\":0,\"s\":\"]\",\"n\":0,\"value\":1}]",
+  };
+  for(size_t i = 0; i < sizeof(docs)/sizeof(docs[0]); ++i){
+    char buf[128];
+    strcpy(buf, docs[i]);
+    ParallelTotals totals = {0};
+    IJ_Error error = ij_parallel_array(buf, 0, .record=array_sum_element,
+        .ctx=&totals, .threads=2, .batch_size=8);
+    ASSERT_TRUE(error != IJ_E_OK);
+  }
+}
+
+void utest_deserialize_parallel_array_file(void){
+  const char* path = "test_file.json";
+  const char* doc = "[{\"id\":1,\"s\":\"\",\"n\":null,\"value\":2},\n"
+    "{\"id\":2,\"s\":\"\",\"n\":[],\"value\":4}]\n";
+  ASSERT_TRUE(nob_write_entire_file(path, doc, strlen(doc)));
+
+  ParallelTotals totals = {0};
+  IJ_Error error = ij_parallel_array_file(path, .record=array_sum_element,
+      .ctx=&totals, .threads=1, .opts={ .read_only=true });
+  ASSERT_TRUE(error == IJ_E_OK);
+  ASSERT_TRUE(totals.sums[0] == 6);
+  ASSERT_TRUE(totals.records[0] == 2);
+
+  remove(path);
+}
+
+void utest_deserialize_push(void){
+  const char* input = " {\"a\":\"x}[\",\"b\":[\"\\\"]\",{\"c\":2}]}\n[3] \"s\"42 ";
+  IJ ij = {0};
+  ij_init(&ij, .push=true, .allocator={ .realloc = ij_libc_realloc });
+
+  // one byte at a time, every document has to come out whole
+  int docs = 0;
+  for(const char* it = input; *it != '\0'; ++it){
+    for(IJ_Error e = ij_feed(&ij, it, 1); e != IJ_E_NEED_MORE; e = ij_feed(&ij, NULL, 0)){
+      ASSERT_TRUE(e == IJ_E_OK);
+      const char* str = NULL;
+      double value = 0.0f;
+      if(docs == 0){
+        ASSERT_TRUE(ij_obj_begin(&ij));
+        ASSERT_TRUE(ij_member(&ij, "a"));
+        ASSERT_TRUE(ij_string(&ij, &str));
+        ASSERT_STREQ(str, "x}[");
+        ASSERT_TRUE(ij_member(&ij, "b"));
+        ASSERT_TRUE(ij_skip_value(&ij));
+        ASSERT_TRUE(ij_obj_end(&ij));
+      }else if(docs == 1){
+        ASSERT_TRUE(ij_array_begin(&ij));
+        ASSERT_TRUE(ij_number(&ij, &value));
+        ASSERT_FLEQ(value, 3.0f);
+        ASSERT_TRUE(ij_array_end(&ij, NULL));
+      }else if(docs == 2){
+        ASSERT_TRUE(ij_string(&ij, &str));
+        ASSERT_STREQ(str, "s");
+      }else{
+        ASSERT_TRUE(ij_number(&ij, &value));
+        ASSERT_FLEQ(value, 42.0f);
+      }
+      docs++;
+    }
+  }
+  ASSERT_TRUE(docs == 4);
+  ij_deinit(&ij);
+}
+
+void utest_deserialize_push_socket(void){
+#if defined(__unix__) || defined(__APPLE__)
+  int fds[2];
+  ASSERT_TRUE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+
+  char buf[16];
+  IJ ij = {0};
+  ij_init(&ij, .push=true, .buf=buf, .buf_len=sizeof(buf));
+
+  const char* chunks[] = { "[1,", "2]" };
+  char recv_buf[8];
+  int sum = 0;
+  for(int i = 0; i < 2; ++i){
+    // nothing to read yet, an event loop would wait for the socket here
+    ASSERT_TRUE(recv(fds[1], recv_buf, sizeof(recv_buf), MSG_DONTWAIT) < 0);
+    ASSERT_TRUE(send(fds[0], chunks[i], strlen(chunks[i]), 0) > 0);
+    int n = recv(fds[1], recv_buf, sizeof(recv_buf), MSG_DONTWAIT);
+    ASSERT_TRUE(n > 0);
+
+    IJ_Error e = ij_feed(&ij, recv_buf, n);
+    if(i == 0){
+      ASSERT_TRUE(e == IJ_E_NEED_MORE);
+      continue;
+    }
+    ASSERT_TRUE(e == IJ_E_OK);
+    int32_t value = 0;
+    ASSERT_TRUE(ij_array_begin(&ij));
+    do{
+      ASSERT_TRUE(ij_int32(&ij, &value));
+      sum += value;
+    }while(!ij_array_end(&ij, NULL));
+  }
+  ASSERT_TRUE(sum == 3);
+  ASSERT_TRUE(ij_feed(&ij, NULL, 0) == IJ_E_NEED_MORE);
+
+  ij_deinit(&ij);
+  close(fds[0]);
+  close(fds[1]);
+#endif
+}
+
+void utest_deserialize_push_errors(void){
+  IJ ij = {0};
+  ij_init(&ij, .push=true, .allocator={ .realloc = ij_libc_realloc });
+  ASSERT_TRUE(ij_feed(&ij, "[{]", 3) == IJ_E_UNEXPECTED_TOKEN);
+  ASSERT_TRUE(ij_feed(&ij, "}]", 2) == IJ_E_UNEXPECTED_TOKEN);
+  ij_deinit(&ij);
+
+  char buf[4];
+  ij_init(&ij, .push=true, .buf=buf, .buf_len=sizeof(buf));
+  ASSERT_TRUE(ij_feed(&ij, "[1,", 3) == IJ_E_NEED_MORE);
+  ASSERT_TRUE(ij_feed(&ij, "2]", 2) == IJ_E_BUF_FULL);
+  ij_deinit(&ij);
+}
+
+void utest_deserialize_array_empty(void){
+  char buf[1024] = "[]";
+  IJ ij = {0};
+  ij_init(&ij, .buf=buf, .serialize=false);
+  
+  ASSERT_TRUE(ij_array_begin(&ij));
+  ASSERT_TRUE(ij_array_end(&ij, NULL));
+
+  ij_deinit(&ij);
+}
+
+void utest_deserialize_array_dynamic(void){
+  char buf[1024] = "[1, 2, 3]";
+  IJ ij = {0};
+  ij_init(&ij, .buf=buf, .serialize=false);
+
+  double items[4] = {0};
+  int count = 0;
+
+  ASSERT_TRUE(ij_array_begin(&ij));
+  do{
+    ASSERT_TRUE(ij_number(&ij, &items[count]));
+  }while(ij_array_end(&ij, &count) == false);
+
+  ASSERT_TRUE(ij_error(&ij) == IJ_E_OK);
+  ASSERT_FLEQ(items[0], 1.0f);
+  ASSERT_FLEQ(items[1], 2.0f);
+  ASSERT_FLEQ(items[2], 3.0f);
+
+  ij_deinit(&ij);
+}
+
+void utest_deserialize_array_nested(void){
+  char buf[1024] = "[[], [[]], {}]";
+  IJ ij = {0};
+  ij_init(&ij, .buf=buf, .serialize=false);
+
+  ASSERT_TRUE(ij_array_begin(&ij));
+    ASSERT_TRUE(ij_array_begin(&ij));
+    ASSERT_TRUE(ij_array_end(&ij, NULL));
+    ASSERT_TRUE(ij_array_begin(&ij));
+      ASSERT_TRUE(ij_array_begin(&ij));
+      ASSERT_TRUE(ij_array_end(&ij, NULL));
+    ASSERT_TRUE(ij_array_end(&ij, NULL));
+    ASSERT_TRUE(ij_obj_begin(&ij));
+    ASSERT_TRUE(ij_obj_end(&ij));
+  ASSERT_TRUE(ij_array_end(&ij, NULL));
+
+  ij_deinit(&ij);
+}
+
+void utest_deserialize_obj_empty(void){
+  char buf[1024] = "{}";
+  IJ ij = {0};
+  ij_init(&ij, .buf=buf, .serialize=false);
+  
+  ASSERT_TRUE(ij_obj_begin(&ij));
+  ASSERT_TRUE(ij_obj_end(&ij));
+
+  ij_deinit(&ij);
+}
+
+void utest_deserialize_obj_static(void){
+  char buf[1024] = "{\"1\":1,\"2\":2}";
+  IJ ij = {0};
+  ij_init(&ij, .buf=buf, .serialize=false);
+  
+  double value = 0.0f;
+  
+  ASSERT_TRUE(ij_obj_begin(&ij));
+
+  ASSERT_TRUE(ij_member(&ij, "1"));
+  ASSERT_TRUE(ij_number(&ij, &value));
+  ASSERT_FLEQ(value, 1.0f);
+  
+  ASSERT_TRUE(ij_member(&ij, "2"));
+  ASSERT_TRUE(ij_number(&ij, &value));
+  ASSERT_FLEQ(value, 2.0f);
+
+  ASSERT_TRUE(ij_obj_end(&ij));
+
+  ij_deinit(&ij);
+}
+
+void utest_deserialize_obj_dynamic(void){
+  char buf[1024] = "{\"1\":1,\"2\":2}";
+  IJ ij = {0};
+  ij_init(&ij, .buf=buf, .serialize=false);
+  
+  double v1 = 0.0f;
+  double v2 = 0.0f;
+  
+  ASSERT_TRUE(ij_obj_begin(&ij));
+  do{
+    if(ij_member(&ij, "1")){
+      ASSERT_TRUE(ij_number(&ij, &v1));
+    }
+    if(ij_member(&ij, "2")){
+      ASSERT_TRUE(ij_number(&ij, &v2));
+    }
+  } while(!ij_obj_end(&ij));
+
+  ASSERT_FLEQ(v1, 1.0f);
+  ASSERT_FLEQ(v2, 2.0f);
+
+  ij_deinit(&ij);
+}
+
+void utest_deserialize_obj_out_of_order(void){
+  char buf[1024] = "{\"2\":2,\"1\":1}";
+  IJ ij = {0};
+  ij_init(&ij, .buf=buf, .serialize=false);
+
+  double v1 = 0.0f;
+  double v2 = 0.0f;
+
+  ASSERT_TRUE(ij_obj_begin(&ij));
+  do{
+    if(ij_member(&ij, "1")){
+      ASSERT_TRUE(ij_number(&ij, &v1));
+    }
+    if(ij_member(&ij, "2")){
+      ASSERT_TRUE(ij_number(&ij, &v2));
+    }
+  } while(!ij_obj_end(&ij));
+
+  ASSERT_FLEQ(v1, 1.0f);
+  ASSERT_FLEQ(v2, 2.0f);
+
+  ij_deinit(&ij);
+}
+
+void utest_deserialize_member_prefix(void){
+  char buf[1024] = "{\"ab\":1}";
+  IJ ij = {0};
+  ij_init(&ij, .buf=buf, .serialize=false);
+
+  ASSERT_TRUE(ij_obj_begin(&ij));
+  ASSERT_FALSE(ij_member(&ij, "a"));
+  ASSERT_FALSE(ij_member(&ij, "abc"));
+  ASSERT_TRUE(ij_member(&ij, "ab"));
+
+  ij_deinit(&ij);
+}
+
+void utest_deserialize_obj_consume_unhandled_members(void){
+  char buf[1024] = "{\"1\":1,\"2\":2,\"3\":3}";
+  IJ ij = {0};
+  ij_init(&ij, .buf=buf, .serialize=false);
+  
+  double v2 = 0.0f;
+  int count = 0;
+  
+  ASSERT_TRUE(ij_obj_begin(&ij));
+  do{
+    if(ij_member(&ij, "2")){
+      ASSERT_TRUE(ij_number(&ij, &v2));
+    }
+    count++;
+  } while(!ij_obj_end(&ij));
+
+  ASSERT_FLEQ(v2, 2.0f);
+
+  ij_deinit(&ij);
+}
+
+typedef struct{
+  double a;
+  const char* b;
+  bool c;
+} SwitchData;
+
+bool switch_data_serde(SwitchData* self, IJ* ij){
+  static const char* const names[] = { "a", "b", "c" };
+  if(!ij_obj_begin(ij)) return false;
+  for(int i; (i = ij_member_switch(ij, names, NOB_ARRAY_LEN(names))) >= 0;){
+    switch(i){
+      case 0: if(!ij_number(ij, &self->a)) return false; break;
+      case 1: if(!ij_string(ij, &self->b)) return false; break;
+      case 2: if(!ij_bool(ij, &self->c)) return false; break;
+    }
+  }
+  return ij_obj_end(ij) && ij_error(ij) == IJ_E_OK;
+}
+
+void utest_serialize_member_switch(void){
+  char buf[1024] = {0};
+  IJ ij = {0};
+  ij_init(&ij, .buf=buf, .buf_len=sizeof(buf), .serialize=true);
+
+  SwitchData data = { .a = 1.0, .b = "str", .c = true };
+  ASSERT_TRUE(switch_data_serde(&data, &ij));
+  ij_deinit(&ij);
+
+  ASSERT_STREQ(buf, "{\"a\":1,\"b\":\"str\",\"c\":true}");
+}
+
+void utest_deserialize_member_switch(void){
+  char buf[1024] = "{\"c\":true,"
+    "\"unknown\":{\"x\":[1,{\"y\":2}],\"z\":null},"
+    "\"b\":\"str\","
+    "\"a\":1}";
+  IJ ij = {0};
+  ij_init(&ij, .buf=buf, .serialize=false);
+
+  SwitchData data = {0};
+  ASSERT_TRUE(switch_data_serde(&data, &ij));
+  ASSERT_FLEQ(data.a, 1.0f);
+  ASSERT_STREQ(data.b, "str");
+  ASSERT_TRUE(data.c);
+
+  ij_deinit(&ij);
+}
+
+IJ_MEMBER_SET(hashed, "alpha", "beta", "gamma", "delta", "epsilon");
+
+void utest_deserialize_member_switch_hashed(void){
+  char buf[1024] = "{\"delta\":4,\"alph\":0,\"epsilon\":5,\"alpha\":1,\"gamma\":3}";
+  IJ ij = {0};
+  ij_init(&ij, .buf=buf, .serialize=false);
+
+  ASSERT_TRUE(hashed_member_lookup("beta", 4) == 1);
+  ASSERT_TRUE(hashed_member_lookup("bet", 3) == -1);
+  ASSERT_TRUE(hashed_member_lookup("zeta", 4) == -1);
+
+  double values[5] = {0};
+  ASSERT_TRUE(ij_obj_begin(&ij));
+  for(int i; (i = ij_member_switch_lookup(&ij, hashed_members,
+          NOB_ARRAY_LEN(hashed_members), hashed_member_lookup)) >= 0;){
+    ASSERT_TRUE(ij_number(&ij, &values[i]));
+  }
+  ASSERT_TRUE(ij_obj_end(&ij));
+  ASSERT_TRUE(ij_error(&ij) == IJ_E_OK);
+
+  ASSERT_FLEQ(values[0], 1.0f);
+  ASSERT_FLEQ(values[1], 0.0f);
+  ASSERT_FLEQ(values[2], 3.0f);
+  ASSERT_FLEQ(values[3], 4.0f);
+  ASSERT_FLEQ(values[4], 5.0f);
+
+  ij_deinit(&ij);
+}
+
+#define SKIP_DOC "{\"a\":1,"\
+  "\"unknown\":{\"x\":[1,{\"y\":\"}]\\\"{[\"}],\"z\":[[],{}],\"s\":\"\\\\\"},"\
+  "\"list\":[\"]\",[{}],true],"\
+  "\"b\":2}"
+
+void skip_doc_read(IJ* ij){
+  double a = 0.0f;
+  double b = 0.0f;
+
+  ASSERT_TRUE(ij_obj_begin(ij));
+  do{
+    if(ij_member(ij, "a")){
+      ASSERT_TRUE(ij_number(ij, &a));
+    }
+    if(ij_member(ij, "b")){
+      ASSERT_TRUE(ij_number(ij, &b));
+    }
+  } while(!ij_obj_end(ij));
+
+  ASSERT_TRUE(ij_error(ij) == IJ_E_OK || ij_error(ij) == IJ_E_MORE_ELEMENTS_AVAILABLE);
+  ASSERT_FLEQ(a, 1.0f);
+  ASSERT_FLEQ(b, 2.0f);
+}
+
+void utest_deserialize_skip_value(void){
+  char buf[1024] = SKIP_DOC;
+  IJ ij = {0};
+  ij_init(&ij, .buf=buf, .serialize=false);
+
+  skip_doc_read(&ij);
+
+  // the skipped value is left untouched, its strings are not terminated
+  char doc[] = SKIP_DOC;
+  char* skipped_begin = strstr(doc, "{\"x\"");
+  char* skipped_end = strstr(doc, ",\"list\"");
+  ASSERT_TRUE(memcmp(buf+(skipped_begin-doc), skipped_begin,
+        skipped_end-skipped_begin) == 0);
+
+  ij_deinit(&ij);
+}
+
+void utest_deserialize_skip_value_index(void){
+  char buf[1024] = SKIP_DOC;
+  uint32_t index[256];
+  IJ ij = {0};
+  ij_init(&ij, .buf=buf, .index=index, .index_len=256, .serialize=false);
+  ASSERT_TRUE(ij.lexer.index != NULL);
+
+  skip_doc_read(&ij);
+
+  ij_deinit(&ij);
+}
+
+void utest_deserialize_skip_value_stream(void){
+  // the skipped member is much larger than the buffer
+  char in[] = SKIP_DOC;
+  char* in_p = in;
+  char buf[16] = {0};
+  IJ ij = {0};
+  ij_init(&ij, .buf=buf, .buf_len=sizeof(buf),
+      .stream = {
+        .ctx = &in_p,
+        .read = test_read,
+      },
+      .serialize=false);
+
+  skip_doc_read(&ij);
+
+  ij_deinit(&ij);
+}
+
+void utest_deserialize_skip_value_array(void){
+  char buf[1024] = "[{\"x\":[1,2]}, \"s\\\"]\", -1.5e3, null, 3]";
+  IJ ij = {0};
+  ij_init(&ij, .buf=buf, .serialize=false);
+
+  double value = 0.0f;
+  ASSERT_TRUE(ij_array_begin(&ij));
+  ASSERT_TRUE(ij_skip_value(&ij));
+  ASSERT_TRUE(ij_skip_value(&ij));
+  ASSERT_TRUE(ij_skip_value(&ij));
+  ASSERT_TRUE(ij_skip_value(&ij));
+  ASSERT_TRUE(ij_number(&ij, &value));
+  ASSERT_FLEQ(value, 3.0f);
+  ASSERT_TRUE(ij_array_end(&ij, NULL));
+  ASSERT_FALSE(ij_skip_value(&ij));
+
+  ij_deinit(&ij);
+}
+
+void utest_intern(void){
+  IJ_Intern intern;
+  ij_intern_init(&intern, (IJ_Allocator){ .realloc = ij_libc_realloc });
+
+  ASSERT_TRUE(ij_intern(&intern, "active", 6) == 0);
+  ASSERT_TRUE(ij_intern(&intern, "inactive", 8) == 1);
+  ASSERT_TRUE(ij_intern(&intern, "active", 6) == 0);
+  ASSERT_TRUE(ij_intern_find(&intern, "act", 3, ij_hash("act", 3, 0)) == -1);
+
+  // grow past the initial entry and slot capacity
+  char str[16];
+  for(int i = 0; i < 1000; ++i){
+    int len = snprintf(str, sizeof(str), "key%d", i);
+    ASSERT_TRUE(ij_intern(&intern, str, len) == i+2);
+  }
+  for(int i = 0; i < 1000; ++i){
+    int len = snprintf(str, sizeof(str), "key%d", i);
+    ASSERT_TRUE(ij_intern_find(&intern, str, len, ij_hash(str, len, 0)) == i+2);
+  }
+  ASSERT_STREQ(ij_intern_str(&intern, 1), "inactive");
+  ASSERT_TRUE(ij_intern_str(&intern, 1002) == NULL);
+
+  ij_intern_free(&intern);
+}
+
+void utest_deserialize_string_interned(void){
+  char buf[1024] = "[\"active\",\"some text\",\"active\",\"inactive\"]";
+  IJ_Intern intern;
+  ij_intern_init(&intern, (IJ_Allocator){ .realloc = ij_libc_realloc });
+  int active = ij_intern(&intern, "active", 6);
+  int inactive = ij_intern(&intern, "inactive", 8);
+
+  IJ ij = {0};
+  ij_init(&ij, .buf=buf, .intern=&intern, .serialize=false);
+
+  const char* a = NULL;
+  const char* text = NULL;
+  const char* b = NULL;
+  int id = -1;
+  ASSERT_TRUE(ij_array_begin(&ij));
+  ASSERT_TRUE(ij_string(&ij, &a));
+  ASSERT_TRUE(ij_string(&ij, &text));
+  ASSERT_TRUE(ij_string(&ij, &b));
+  ASSERT_TRUE(ij_string_id(&ij, &id));
+  ASSERT_TRUE(ij_array_end(&ij, NULL));
+  ij_deinit(&ij);
+
+  ASSERT_TRUE(a == ij_intern_str(&intern, active));
+  ASSERT_TRUE(a == b);
+  ASSERT_STREQ(text, "some text");
+  ASSERT_TRUE(text > buf && text < buf+sizeof(buf));
+  ASSERT_TRUE(id == inactive);
+
+  ij_intern_free(&intern);
+}
+
+void utest_deserialize_member_id(void){
+  char buf[1024] = "[{\"id\":1,\"status\":\"ok\",\"long unknown key\":[1,2]},"
+    "{\"status\":\"ok\",\"id\":2}]";
+  IJ_Intern intern;
+  ij_intern_init(&intern, (IJ_Allocator){ .realloc = ij_libc_realloc });
+  intern.auto_max_len = 8;
+
+  IJ ij = {0};
+  ij_init(&ij, .buf=buf, .intern=&intern, .serialize=false);
+
+  double sum = 0.0f;
+  int statuses[2] = { -1, -1 };
+  int count = 0;
+  ASSERT_TRUE(ij_array_begin(&ij));
+  do{
+    ASSERT_TRUE(ij_obj_begin(&ij));
+    for(int key; (key = ij_member_id(&ij)) >= 0;){
+      const char* name = ij_intern_str(&intern, key);
+      if(strcmp(name, "id") == 0){
+        double value = 0.0f;
+        ASSERT_TRUE(ij_number(&ij, &value));
+        sum += value;
+      }else if(strcmp(name, "status") == 0){
+        ASSERT_TRUE(ij_string_id(&ij, &statuses[count]));
+      }
+    }
+    ASSERT_TRUE(ij_obj_end(&ij));
+    count++;
+  }while(!ij_array_end(&ij, NULL));
+  ij_deinit(&ij);
+
+  ASSERT_FLEQ(sum, 3.0f);
+  ASSERT_TRUE(count == 2);
+  ASSERT_TRUE(statuses[0] >= 0 && statuses[0] == statuses[1]);
+  ASSERT_TRUE(intern.count == 3);
+
+  ij_intern_free(&intern);
+}
+
+void utest_serialize_string_id(void){
+  char buf[1024] = {0};
+  IJ_Intern intern;
+  ij_intern_init(&intern, (IJ_Allocator){ .realloc = ij_libc_realloc });
+  int id = ij_intern(&intern, "active", 6);
+  int unknown = 7;
+
+  IJ ij = {0};
+  ij_init(&ij, .buf=buf, .buf_len=sizeof(buf), .intern=&intern, .serialize=true);
+  ASSERT_TRUE(ij_array_begin(&ij));
+  ASSERT_TRUE(ij_string_id(&ij, &id));
+  ASSERT_FALSE(ij_string_id(&ij, &unknown));
+  ASSERT_TRUE(ij_error(&ij) == IJ_E_ARG_NO_INTERN);
+  ij_deinit(&ij);
+
+  ASSERT_STREQ(buf, "[\"active\"");
+  ij_intern_free(&intern);
+}
+
+// writes the events ij_any reads as one letter each, with keys and
+// strings in parentheses
+bool any_events(IJ* ij, char* out, int size){
+  IJ_Any value = {0};
+  int n = 0;
+  while(ij_any(ij, &value)){
+    switch(value.type){
+      case IJ_OBJ_BEGIN: n += snprintf(out+n, size-n, "{"); break;
+      case IJ_OBJ_END: n += snprintf(out+n, size-n, "}"); break;
+      case IJ_ARRAY_BEGIN: n += snprintf(out+n, size-n, "["); break;
+      case IJ_ARRAY_END: n += snprintf(out+n, size-n, "]"); break;
+      case IJ_KEY: n += snprintf(out+n, size-n, "k(%.*s)", value.len, value.as.String); break;
+      case IJ_STRING: n += snprintf(out+n, size-n, "s(%.*s)", value.len, value.as.String); break;
+      case IJ_NUMBER: n += snprintf(out+n, size-n, "n(%g)", value.as.Number); break;
+      case IJ_BOOL: n += snprintf(out+n, size-n, "b(%d)", value.as.Bool); break;
+      case IJ_NULL: n += snprintf(out+n, size-n, "0"); break;
+    }
+    if(ij->depth == 0) return true;
+  }
+  return false;
+}
+
+void utest_deserialize_any(void){
+  char buf[1024] = "{\"a\":[1,\"x\",{}],\"b\":{\"c\":true,\"d\":null},\"e\":\"y\"}";
+  IJ ij = {0};
+  ij_init(&ij, .buf=buf, .serialize=false);
+
+  char events[256];
+  ASSERT_TRUE(any_events(&ij, events, sizeof(events)));
+  ASSERT_STREQ(events, "{k(a)[n(1)s(x){}]k(b){k(c)b(1)k(d)0}k(e)s(y)}");
+  IJ_Any value = {0};
+  ASSERT_FALSE(ij_any(&ij, &value));
+  ASSERT_TRUE(ij_error(&ij) == IJ_E_END_OF_INPUT);
+  ij_deinit(&ij);
+}
+
+void utest_deserialize_any_invalid(void){
+  const char* docs[] = {
+    "[1 2]", "[,1]", "{\"a\":1 \"b\":2}", "{\"a\":}", "{\"a\":1,}", "[1,]",
+    "[1}", "{\"a\":1]", "{1}", "{\"a\":1,2}", "]",
+  };
+  for(size_t i = 0; i < sizeof(docs)/sizeof(docs[0]); ++i){
+    char buf[64] = {0};
+    strcpy(buf, docs[i]);
+    IJ ij = {0};
+    ij_init(&ij, .buf=buf, .serialize=false);
+
+    char events[256];
+    ASSERT_FALSE(any_events(&ij, events, sizeof(events)));
+    ASSERT_TRUE(ij_error(&ij) == IJ_E_UNEXPECTED_TOKEN);
+    ij_deinit(&ij);
+  }
+}
+
+void utest_deserialize_any_stream(void){
+  char buf[8] = {0};
+  char* input = "{ \"key\" : [ \"value\" , -2.5 , false ] }";
+  IJ ij = {0};
+  ij_init(&ij, .buf=buf, .buf_len=sizeof(buf),
+      .stream.read=test_read, .stream.ctx=&input, .serialize=false);
+
+  char events[256];
+  ASSERT_TRUE(any_events(&ij, events, sizeof(events)));
+  ASSERT_STREQ(events, "{k(key)[s(value)n(-2.5)b(0)]}");
+  ij_deinit(&ij);
+}
+
+void utest_deserialize_any_mixed(void){
+  char buf[1024] = "{\"a\":1,\"b\":2}";
+  IJ ij = {0};
+  ij_init(&ij, .buf=buf, .serialize=false);
+
+  IJ_Any value = {0};
+  double number = 0.0f;
+  ASSERT_TRUE(ij_any(&ij, &value) && value.type == IJ_OBJ_BEGIN);
+  ASSERT_TRUE(ij_any(&ij, &value) && value.type == IJ_KEY);
+  ASSERT_TRUE(ij_number(&ij, &number));
+  ASSERT_FLEQ(number, 1.0f);
+  ASSERT_TRUE(ij_member(&ij, "b"));
+  ASSERT_TRUE(ij_any(&ij, &value) && value.type == IJ_NUMBER);
+  ASSERT_FLEQ(value.as.Number, 2.0f);
+  ASSERT_TRUE(ij_obj_end(&ij));
+  ij_deinit(&ij);
+}
+
+void utest_serialize_any_key(void){
+  char buf[1024] = {0};
+  IJ ij = {0};
+  ij_init(&ij, .buf=buf, .buf_len=sizeof(buf), .serialize=true);
+
+  IJ_Any events[] = {
+    { .type = IJ_OBJ_BEGIN },
+    { .type = IJ_KEY, .as.String = "a" },
+    { .type = IJ_BOOL, .as.Bool = true },
+    { .type = IJ_OBJ_END },
+  };
+  for(size_t i = 0; i < sizeof(events)/sizeof(events[0]); ++i){
+    ASSERT_TRUE(ij_any(&ij, &events[i]));
+  }
+  ij_deinit(&ij);
+
+  ASSERT_STREQ(buf, "{\"a\":true}");
+}
+
+void utest_deserialize_tape(void){
+  char buf[1024] = "{\"items\":[1,[2,3],{\"x\":null}],\"id\":9007199254740993,"
+    "\"name\":\"tape\",\"ok\":true,\"empty\":{}}";
+  IJ_Arena arena;
+  ij_arena_init(&arena, (IJ_Allocator){ .realloc = ij_libc_realloc }, 0);
+  IJ ij = {0};
+  ij_init(&ij, .buf=buf, .serialize=false);
+
+  IJ_Tape tape;
+  ASSERT_TRUE(ij_tape_build(&ij, &tape, &arena));
+  ij_deinit(&ij);
+
+  // members in any order
+  const char* str = NULL;
+  int len = 0;
+  bool ok = false;
+  int64_t id = 0;
+  double number = 0.0f;
+  ASSERT_TRUE(ij_tape_string(&tape, ij_tape_member(&tape, 0, "name"), &str, &len));
+  ASSERT_TRUE(len == 4 && strncmp(str, "tape", 4) == 0);
+  ASSERT_TRUE(ij_tape_bool(&tape, ij_tape_member(&tape, 0, "ok"), &ok));
+  ASSERT_TRUE(ok);
+  ASSERT_TRUE(ij_tape_int64(&tape, ij_tape_member(&tape, 0, "id"), &id));
+  ASSERT_TRUE(id == 9007199254740993LL);
+  ASSERT_TRUE(ij_tape_member(&tape, 0, "missing") == -1);
+
+  int items = ij_tape_member(&tape, 0, "items");
+  ASSERT_TRUE(ij_tape_type(&tape, items) == IJ_ARRAY_BEGIN);
+  ASSERT_TRUE(ij_tape_number(&tape, ij_tape_element(&tape, items, 0), &number));
+  ASSERT_FLEQ(number, 1.0f);
+  int nested = ij_tape_element(&tape, items, 1);
+  ASSERT_TRUE(ij_tape_number(&tape, ij_tape_element(&tape, nested, 1), &number));
+  ASSERT_FLEQ(number, 3.0f);
+  int obj = ij_tape_element(&tape, items, 2);
+  ASSERT_TRUE(ij_tape_type(&tape, ij_tape_member(&tape, obj, "x")) == IJ_NULL);
+  ASSERT_TRUE(ij_tape_element(&tape, items, 3) == -1);
+
+  int empty = ij_tape_member(&tape, 0, "empty");
+  ASSERT_TRUE(ij_tape_type(&tape, empty+1) == IJ_OBJ_END);
+  ASSERT_TRUE(ij_tape_next(&tape, 0) == tape.len);
+
+  ij_arena_free(&arena);
+}
+
+void utest_deserialize_tape_elements(void){
+  char buf[1024] = "[{\"v\":1},{\"v\":2},{\"v\":3}]";
+  IJ_Arena arena;
+  ij_arena_init(&arena, (IJ_Allocator){ .realloc = ij_libc_realloc }, 0);
+  IJ ij = {0};
+  ij_init(&ij, .buf=buf, .serialize=false);
+
+  double sum = 0.0f;
+  ASSERT_TRUE(ij_array_begin(&ij));
+  do{
+    IJ_Tape tape;
+    double value = 0.0f;
+    ASSERT_TRUE(ij_tape_build(&ij, &tape, &arena));
+    ASSERT_TRUE(ij_tape_number(&tape, ij_tape_member(&tape, 0, "v"), &value));
+    sum += value;
+    ij_arena_reset(&arena);
+  }while(!ij_array_end(&ij, NULL));
+  ij_deinit(&ij);
+
+  ASSERT_FLEQ(sum, 6.0f);
+  ij_arena_free(&arena);
+}
+
+void utest_deserialize_tape_invalid(void){
+  const char* docs[] = { "[1,]", "{\"a\" 1}", "[1 2]", "{\"a\":1]", "[" };
+  IJ_Arena arena;
+  ij_arena_init(&arena, (IJ_Allocator){ .realloc = ij_libc_realloc }, 0);
+  for(size_t i = 0; i < sizeof(docs)/sizeof(docs[0]); ++i){
+    char buf[64];
+    strcpy(buf, docs[i]);
+    IJ ij = {0};
+    ij_init(&ij, .buf=buf, .serialize=false);
+    IJ_Tape tape;
+    ASSERT_FALSE(ij_tape_build(&ij, &tape, &arena));
+    ASSERT_TRUE(ij_error(&ij) != IJ_E_OK);
+    ij_deinit(&ij);
+  }
+  ij_arena_free(&arena);
+}
+
+void utest_deserialize_number_unexpected_end_of_input(void){
+  char buf[1024] = "1.";
+  IJ ij = {0};
+  ij_init(&ij, .buf=buf, .buf_len=strlen(buf), .serialize=false);
+  
+  double value = 0.0f;
+  ASSERT_FALSE(ij_number(&ij, &value));
+
+  ASSERT_TRUE(ij_error(&ij) == IJ_E_END_OF_INPUT);
+
+  ij_deinit(&ij);
+}
+
+void utest_deserialize_string_unexpected_end_of_input(void){
+  char buf[1024] = "\"test";
+  IJ ij = {0};
+  ij_init(&ij, .buf=buf, .serialize=false);
+  
+  ASSERT_FALSE(ij_string(&ij,NULL));
+
+  ASSERT_TRUE(ij_error(&ij) == IJ_E_END_OF_INPUT);
+
+  ij_deinit(&ij);
+}
+
+void utest_deserialize_array_unexpected_end_of_input(void){
+  char buf[1024] = "[";
+  IJ ij = {0};
+  ij_init(&ij, .buf=buf, .serialize=false);
+  
+  ASSERT_TRUE(ij_array_begin(&ij));
+  ASSERT_TRUE(ij_array_end(&ij, NULL));
+
+  ASSERT_TRUE(ij_error(&ij) == IJ_E_END_OF_INPUT);
+
+  ij_deinit(&ij);
+}
+
+void utest_deserialize_obj_unexpected_end_of_input(void){
+  char buf[1024] = "{";
+  IJ ij = {0};
+  ij_init(&ij, .buf=buf, .serialize=false);
+  
+  ASSERT_TRUE(ij_obj_begin(&ij));
+  ASSERT_TRUE(ij_obj_end(&ij));
+
+  ASSERT_TRUE(ij_error(&ij) == IJ_E_END_OF_INPUT);
+
+  ij_deinit(&ij);
+}
+
+void utest_deserialize_string_stream_lifetime_error(void){
+  char in[] = "[\"str1\",\"str2\",\"str3\"]";
+  char* in_p = in;
+  char buf[8];
+  IJ ij = {0};
+  ij_init(&ij, .buf=buf, .buf_len=sizeof(buf), 
+      .stream = {
         .ctx = &in_p,
         .read = test_read,
       },
@@ -755,6 +2502,74 @@ void utest_deserialize_string_stream_lifetime_error(void){
   ASSERT_STREQ(str3, "str3");
 }
 
+void utest_arena(void){
+  int live = 0;
+  IJ_Arena arena;
+  ij_arena_init(&arena, (IJ_Allocator){ .ctx = &live, .realloc = test_realloc }, 64);
+
+  char* a = ij_arena_strndup(&arena, "abc", 2);
+  ASSERT_STREQ(a, "ab");
+  char* b = ij_arena_alloc(&arena, 48);
+  ASSERT_TRUE(b != NULL);
+  ASSERT_TRUE(live == 1);
+  // larger than a chunk
+  char* c = ij_arena_alloc(&arena, 200);
+  ASSERT_TRUE(c != NULL);
+  ASSERT_TRUE(live == 2);
+
+  ij_arena_reset(&arena);
+  ASSERT_TRUE(ij_arena_alloc(&arena, 32) == a);
+  ASSERT_TRUE(ij_arena_alloc(&arena, 100) == c);
+  ASSERT_TRUE(live == 2);
+
+  ij_arena_free(&arena);
+  ASSERT_TRUE(live == 0);
+}
+
+void utest_deserialize_string_stream_arena(void){
+  int live = 0;
+  IJ_Arena arena;
+  ij_arena_init(&arena, (IJ_Allocator){ .ctx = &live, .realloc = test_realloc }, 0);
+
+  for(int run = 0; run < 2; ++run){
+    char in[] = "[\"str1\",\"str2\",\"a string longer than the buffer\",\"str3\"]";
+    char* in_p = in;
+    char buf[8] = {0};
+    IJ ij = {0};
+    ij_init(&ij, .buf=buf, .buf_len=sizeof(buf),
+        .stream = {
+          .ctx = &in_p,
+          .read = test_read,
+        },
+        .arena = &arena,
+        .serialize=false);
+
+    const char* str1 = NULL;
+    const char* str2 = NULL;
+    const char* str3 = NULL;
+    const char* str4 = NULL;
+    ASSERT_TRUE(ij_array_begin(&ij));
+    ASSERT_TRUE(ij_string(&ij, &str1));
+    ASSERT_TRUE(ij_string(&ij, &str2));
+    ASSERT_TRUE(ij_string(&ij, &str3));
+    ASSERT_TRUE(ij_string(&ij, &str4));
+    ASSERT_TRUE(ij_array_end(&ij, NULL));
+    ij_deinit(&ij);
+
+    ASSERT_STREQ(str1, "str1");
+    ASSERT_STREQ(str2, "str2");
+    ASSERT_STREQ(str3, "a string longer than the buffer");
+    ASSERT_STREQ(str4, "str3");
+
+    // the second document reuses the chunks of the first
+    ASSERT_TRUE(live == 1);
+    ij_arena_reset(&arena);
+  }
+
+  ij_arena_free(&arena);
+  ASSERT_TRUE(live == 0);
+}
+
 void utest_deserialize_string_stream_lifetime_fixed(void){
   char in[] = "[\"str1\",\"str2\",\"str3\"]";
   char* in_p = in;